@@ -19,10 +19,19 @@
 
 #include<algorithm>
 #include<array>
+#include<atomic>
 #include<cassert>
+#include<condition_variable>
+#include<cstdint>
 #include<fstream>
 #include<filesystem>
 #include<iostream>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<string_view>
+#include<thread>
+#include<unordered_map>
 #include<vector>
 
 namespace SnapTools {
@@ -155,6 +164,415 @@ namespace SnapTools {
             && line[line.size() - 1] == escape_char
             && !SnapTools::char_escaped(line, line.size() - 1, escape_char);
     }
+
+    class StringPool;
+
+    // Immutable string stored in a StringPool. A pool keeps every distinct
+    // string once, so two SharedStrings from the same pool are compared by
+    // pointer only. Comparing strings from different pools is meaningless;
+    // comparison with std::string compares contents.
+    class SharedString {
+    protected:
+        std::shared_ptr<const std::string> str;
+
+        explicit SharedString(std::shared_ptr<const std::string> str)
+            : str{std::move(str)}
+        {
+        }
+
+        friend class StringPool;
+
+    public:
+        SharedString() = default;
+
+        const std::string& get() const
+        {
+            static const std::string empty;
+            return str ? *str : empty;
+        }
+
+        operator const std::string&() const
+        {
+            return get();
+        }
+
+        size_t size() const
+        {
+            return get().size();
+        }
+
+        const char* c_str() const
+        {
+            return get().c_str();
+        }
+
+        bool operator==(const SharedString& other) const
+        {
+            return str == other.str;
+        }
+
+        bool operator!=(const SharedString& other) const
+        {
+            return str != other.str;
+        }
+
+        friend bool operator==(const SharedString& a, const std::string& b)
+        {
+            return a.get() == b;
+        }
+
+        friend bool operator==(const std::string& a, const SharedString& b)
+        {
+            return a == b.get();
+        }
+
+        friend bool operator!=(const SharedString& a, const std::string& b)
+        {
+            return a.get() != b;
+        }
+
+        friend bool operator!=(const std::string& a, const SharedString& b)
+        {
+            return a != b.get();
+        }
+
+        friend std::ostream& operator<<(std::ostream& stream, const SharedString& str)
+        {
+            return stream << str.get();
+        }
+    };
+
+    // Thread-safe pool storing every distinct string once. An entry is freed
+    // as soon as the last SharedString referencing it is destroyed. Created
+    // only through create().
+    class StringPool : public std::enable_shared_from_this<StringPool> {
+    protected:
+        std::mutex mutex;
+        std::unordered_map<std::string_view, std::weak_ptr<const std::string>> entries;
+
+        StringPool() = default;
+
+        void release(const std::string* str)
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                auto f{entries.find(*str)};
+
+                // Entry could have been replaced while this one was expiring
+                if (f != entries.end() && f->first.data() == str->data())
+                    entries.erase(f);
+            }
+
+            delete str;
+        }
+
+        // Has to be called with mutex locked
+        std::shared_ptr<const std::string> find(const std::string_view value)
+        {
+            auto f{entries.find(value)};
+
+            if (f == entries.end())
+                return nullptr;
+
+            auto str{f->second.lock()};
+
+            if (!str)
+                entries.erase(f);
+
+            return str;
+        }
+
+        template<typename String>
+        SharedString insert(String&& value)
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+
+                if (auto str{find(value)})
+                    return SharedString{std::move(str)};
+            }
+
+            // Allocated without holding mutex: if this throws, the deleter
+            // calls release(), which locks it
+            auto pool{shared_from_this()};
+            std::shared_ptr<const std::string> str{
+                new std::string(std::forward<String>(value)),
+                [pool] (const std::string* released)
+                {
+                    pool->release(released);
+                }
+            };
+            std::shared_ptr<const std::string> existing;
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                existing = find(*str);
+
+                if (!existing)
+                    entries.emplace(*str, str);
+            }
+
+            // Another thread interned the same string meanwhile. The unused
+            // copy is released after mutex was unlocked
+            if (existing)
+                return SharedString{std::move(existing)};
+
+            return SharedString{std::move(str)};
+        }
+
+    public:
+        static std::shared_ptr<StringPool> create()
+        {
+            return std::shared_ptr<StringPool>(new StringPool);
+        }
+
+    public:
+        SharedString intern(const std::string& value)
+        {
+            return insert(value);
+        }
+
+        // Moves value into the pool if it isn't stored yet
+        SharedString intern(std::string&& value)
+        {
+            return insert(std::move(value));
+        }
+
+        // Returns number of distinct strings currently stored
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            return entries.size();
+        }
+    };
+}
+
+// Diagnostics are reported through a Sink. Defining SNAPCONFIG_NO_DIAGNOSTICS
+// before including this header compiles all reporting out.
+namespace SnapDiagnostics {
+    struct Message {
+        short code{};
+        int line_number{};
+        std::string key;
+        std::string text;
+        std::string type;
+        char end_char{'\n'};
+    };
+
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+
+        // May be called from several threads at once
+        virtual void write(const Message& message) = 0;
+
+        virtual void write_batch(const std::vector<Message>& messages)
+        {
+            for (const Message& message : messages)
+                write(message);
+        }
+    };
+
+    class StderrSink : public Sink {
+    public:
+        void write(const Message& message) override
+        {
+            // Single write, so lines from different threads don't interleave
+            std::cerr << "SnapConfig[" + message.type + "]: " + message.text
+                + message.end_char;
+        }
+    };
+
+    // Queues messages in a bounded lock-free ring buffer and hands them to the
+    // target sink in batches from a worker thread. When the buffer is full
+    // new messages are dropped and counted. An idle worker blocks instead of
+    // polling; writers only take the mutex to wake it up.
+    class AsyncSink : public Sink {
+    protected:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            Message message;
+        };
+
+        std::shared_ptr<Sink> target;
+        std::unique_ptr<Cell[]> cells;
+        size_t mask{};
+        size_t max_batch{};
+        alignas(64) std::atomic<size_t> enqueue_pos{};
+        alignas(64) std::atomic<size_t> dequeue_pos{};
+        std::atomic<size_t> written{};
+        std::atomic<size_t> dropped{};
+        std::atomic<bool> stopping{};
+        std::atomic<bool> sleeping{};
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::condition_variable flushed;
+        std::thread worker;
+
+        // Only called from the worker thread
+        bool has_pending()
+        {
+            const size_t pos{dequeue_pos.load(std::memory_order_relaxed)};
+            const size_t seq{cells[pos & mask].sequence.load(std::memory_order_seq_cst)};
+
+            return seq == pos + 1;
+        }
+
+        bool pop(Message& message)
+        {
+            const size_t pos{dequeue_pos.load(std::memory_order_relaxed)};
+            Cell& cell{cells[pos & mask]};
+            const size_t seq{cell.sequence.load(std::memory_order_acquire)};
+
+            if (static_cast<std::intptr_t>(seq - (pos + 1)) < 0)
+                return false;
+
+            message = std::move(cell.message);
+            cell.sequence.store(pos + mask + 1, std::memory_order_release);
+            dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        void run()
+        {
+            std::vector<Message> batch;
+            Message message;
+
+            while (true) {
+                batch.clear();
+
+                while (batch.size() < max_batch && pop(message))
+                    batch.push_back(std::move(message));
+
+                if (batch.size()) {
+                    target->write_batch(batch);
+                    written.fetch_add(batch.size(), std::memory_order_release);
+                    { std::lock_guard<std::mutex> lock{mutex}; }
+                    flushed.notify_all();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock{mutex};
+                // Sequentially consistent together with write(): either the
+                // writer sees sleeping set, or has_pending() sees its message
+                sleeping.store(true, std::memory_order_seq_cst);
+                wakeup.wait(lock, [this] {
+                    return stopping.load(std::memory_order_acquire) || has_pending();
+                });
+                sleeping.store(false, std::memory_order_relaxed);
+
+                if (stopping.load(std::memory_order_acquire) && !has_pending())
+                    break;
+            }
+        }
+
+    public:
+        AsyncSink(std::shared_ptr<Sink> target,
+                  const size_t capacity = 1024,
+                  const size_t max_batch = 64
+        ) : target{std::move(target)}, max_batch{std::max<size_t>(max_batch, 1)}
+        {
+            assert(this->target);
+            size_t size{2};
+
+            while (size < capacity)
+                size <<= 1;
+
+            cells.reset(new Cell[size]);
+            mask = size - 1;
+
+            for (size_t i{}; i < size; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+
+            worker = std::thread{&AsyncSink::run, this};
+        }
+
+        AsyncSink(const AsyncSink&) = delete;
+        AsyncSink& operator=(const AsyncSink&) = delete;
+
+        // Delivers everything still queued before returning
+        ~AsyncSink() override
+        {
+            stopping.store(true, std::memory_order_release);
+            { std::lock_guard<std::mutex> lock{mutex}; }
+            wakeup.notify_one();
+            worker.join();
+        }
+
+        void write(const Message& message) override
+        {
+            size_t pos{enqueue_pos.load(std::memory_order_relaxed)};
+            Cell* cell;
+
+            while (true) {
+                cell = &cells[pos & mask];
+                const size_t seq{cell->sequence.load(std::memory_order_acquire)};
+                const auto diff{static_cast<std::intptr_t>(seq - pos)};
+
+                if (!diff) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                else
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+
+            cell->message = message;
+            cell->sequence.store(pos + 1, std::memory_order_seq_cst);
+
+            if (sleeping.load(std::memory_order_seq_cst)) {
+                { std::lock_guard<std::mutex> lock{mutex}; }
+                wakeup.notify_one();
+            }
+        }
+
+        // Blocks until every message queued so far reached the target sink
+        void flush()
+        {
+            const size_t queued{enqueue_pos.load(std::memory_order_acquire)};
+            std::unique_lock<std::mutex> lock{mutex};
+
+            flushed.wait(lock, [this, queued] {
+                return written.load(std::memory_order_acquire) >= queued;
+            });
+        }
+
+        // Returns number of messages lost because the buffer was full
+        size_t get_dropped() const
+        {
+            return dropped.load(std::memory_order_relaxed);
+        }
+    };
+
+    inline std::shared_ptr<Sink>& default_sink_storage()
+    {
+        static std::shared_ptr<Sink> sink{std::make_shared<StderrSink>()};
+        return sink;
+    }
+
+    // Sink given to every SnapConfig constructed afterwards. Pass nullptr to
+    // silence new instances.
+    inline void set_default_sink([[maybe_unused]] std::shared_ptr<Sink> sink)
+    {
+#ifndef SNAPCONFIG_NO_DIAGNOSTICS
+        std::atomic_store(&default_sink_storage(), std::move(sink));
+#endif
+    }
+
+    inline std::shared_ptr<Sink> get_default_sink()
+    {
+#ifdef SNAPCONFIG_NO_DIAGNOSTICS
+        return nullptr;
+#else
+        return std::atomic_load(&default_sink_storage());
+#endif
+    }
 }
 
 class SnapConfig {
@@ -162,6 +580,26 @@ protected:
     bool new_line_escaped{};
     short error{};
     bool strip_value{};
+    std::shared_ptr<SnapDiagnostics::Sink> diagnostic_sink;
+    std::shared_ptr<SnapTools::StringPool> string_pool;
+
+    // Finds a read variable's value in whichever storage is in use
+    const std::string* find_value(const std::string& key)
+    {
+        if (string_pool) {
+            auto f{std::find_if(shared_variables.begin(), shared_variables.end(),
+                [&key] (const SharedVariable& var) { return var.key == key; }
+            )};
+
+            return f == shared_variables.end() ? nullptr : &f->value.get();
+        }
+
+        auto f{std::find_if(config_variables.begin(), config_variables.end(),
+            [&key] (const Variable& var) { return var.key == key; }
+        )};
+
+        return f == config_variables.end() ? nullptr : &f->value;
+    }
 
 public:
     struct Variable {
@@ -169,6 +607,12 @@ public:
         std::string value;
     };
 
+    // Variable as it's stored when a string pool is used
+    struct SharedVariable {
+        SnapTools::SharedString key;
+        SnapTools::SharedString value;
+    };
+
     struct Escapable {
         const char character{};
         const char replacement{};
@@ -179,10 +623,14 @@ public:
         variable_not_found,
         wrong_type,
         init,
+        syntax, // Malformed config line. Only reported through diagnostics
     };
 
     std::string config_file;
+    // Stays empty when instance has a string pool, see shared_variables
     std::vector<Variable> config_variables;
+    // Used instead of config_variables when instance has a string pool
+    std::vector<SharedVariable> shared_variables;
     std::vector<Variable> default_variables;
     static const char default_separating_char{':'};
     static const char default_escape_char{'\\'};
@@ -199,8 +647,12 @@ public:
 
     SnapConfig(const std::string& config_file,
                const char separating_char = default_separating_char,
-               const char escape_char = default_escape_char
-    ) : escape_char{escape_char}, separating_char{separating_char}, error{Error::no_error}
+               const char escape_char = default_escape_char,
+               std::shared_ptr<SnapDiagnostics::Sink> diagnostic_sink
+                   = SnapDiagnostics::get_default_sink(),
+               std::shared_ptr<SnapTools::StringPool> string_pool = nullptr
+    ) : escape_char{escape_char}, separating_char{separating_char}, error{Error::no_error},
+        diagnostic_sink{std::move(diagnostic_sink)}, string_pool{std::move(string_pool)}
     {
         read_config(config_file);
     }
@@ -217,15 +669,17 @@ public:
     {
         if (separating_char == escape_char) {
             error = Error::init;
-            debug("escape char and separating char can't hold the same value",
-                "fatal error");
+            debug(Error::init, 0, "", [] {
+                return "escape char and separating char can't hold the same value";
+            }, "fatal error");
         }
 
         if (!std::filesystem::exists(config_file)) {
             error = Error::init;
-            const std::string abs_path{std::filesystem::absolute(config_file)};
-            debug("file '" + abs_path + "' doesn't exist.",
-                "fatal error");
+            debug(Error::init, 0, "", [this] {
+                return "file '" + std::filesystem::absolute(config_file).string()
+                    + "' doesn't exist.";
+            }, "fatal error");
         }
     }
 
@@ -257,8 +711,10 @@ public:
                 key_name = SnapTools::strip(key_name);
 
                 if (!key_name.size()) {
-                    debug("config line number " + std::to_string(line_number)
-                        + " is missing a variable's key name");
+                    debug(Error::syntax, line_number, "", [line_number] {
+                        return "config line number " + std::to_string(line_number)
+                            + " is missing a variable's key name";
+                    });
 
                     return Variable();
                 }
@@ -280,13 +736,17 @@ public:
         }
 
         if (!key_name.size()) {
-            debug("config line number " + std::to_string(line_number)
-                + " is missing a variable's key name");
+            debug(Error::syntax, line_number, "", [line_number] {
+                return "config line number " + std::to_string(line_number)
+                    + " is missing a variable's key name";
+            });
             return Variable();
         }
         else if (!get_value) {
-            debug("config line number " + std::to_string(line_number)
-                + " is missing a separating character");
+            debug(Error::syntax, line_number, key_name, [line_number] {
+                return "config line number " + std::to_string(line_number)
+                    + " is missing a separating character";
+            });
             return Variable();
         }
 
@@ -341,6 +801,7 @@ public:
             return;
 
         config_variables.clear();
+        shared_variables.clear();
         std::fstream file;
         file.open(config_file);
         
@@ -350,9 +811,10 @@ public:
             if (error)
                 return;
 
-            std::string abs_path = std::filesystem::absolute(config_file);
-            debug("user has no access to file '" + abs_path + "'",
-                "fatal error");
+            debug(Error::init, 0, "", [&config_file] {
+                return "user has no access to file '"
+                    + std::filesystem::absolute(config_file).string() + "'";
+            }, "fatal error");
             error = Error::init;
 
             return;
@@ -379,7 +841,14 @@ public:
                 continue;
 
             if (!new_line_escaped) {
-                if (cache_var.key.size())
+                if (cache_var.key.size() && string_pool) {
+                    format_string(cache_var.value);
+                    shared_variables.push_back({
+                        string_pool->intern(std::move(cache_var.key)),
+                        string_pool->intern(std::move(cache_var.value))
+                    });
+                }
+                else if (cache_var.key.size())
                     config_variables.push_back(cache_var);
 
                 cache_var = Variable{};
@@ -400,26 +869,49 @@ public:
     {
         if (!is_config_init()) {
             if (verbose) {
-                debug("can't get key '" + key + "' due to"
-                    " a prior fatal error");
+                debug(Error::init, 0, key, [&key] {
+                    return "can't get key '" + key + "' due to"
+                        " a prior fatal error";
+                });
             }
             return "";
         }
 
         error = Error::no_error;
-        auto f{std::find_if(config_variables.begin(), config_variables.end(),
-            [key] (const Variable& var) { return var.key == key; }
-        )};
+        const std::string* value{find_value(key)};
 
-        if (f == config_variables.end()) {
+        if (!value) {
             const std::string default_variable{get_default(key)};
 
             if (verbose)
-                debug("variable '" + key + "' not found");
+                debug(Error::variable_not_found, 0, key, [&key] {
+                    return "variable '" + key + "' not found";
+                });
 
             return default_variable;
         }
 
+        return *value;
+    }
+
+    // Same as get(), but a key interned by this instance's string pool is
+    // found by comparing pointers instead of contents
+    std::string get(const SnapTools::SharedString& key,
+                    const bool verbose = false)
+    {
+        if (!string_pool || !is_config_init())
+            return get(key.get(), verbose);
+
+        auto f{std::find_if(shared_variables.begin(), shared_variables.end(),
+            [&key] (const SharedVariable& var) { return var.key == key; }
+        )};
+
+        // Key could come from another pool, so fall back to contents
+        if (f == shared_variables.end())
+            return get(key.get(), verbose);
+
+        error = Error::no_error;
+
         return f->value;
     }
 
@@ -435,7 +927,9 @@ public:
 
             if (!SnapTools::is_int(result)) {
                 if (verbose)
-                    debug("key '" + key + "' is not an int type");
+                    debug(Error::wrong_type, 0, key, [&key] {
+                        return "key '" + key + "' is not an int type";
+                    });
                 error = Error::wrong_type;
                 return 0;
             }
@@ -444,8 +938,10 @@ public:
         }
         catch (std::out_of_range ofr) {
             if (verbose) {
-                debug("variable \"" + key + "\" is way too big"
-                      " and can't fit info long int");
+                debug(Error::wrong_type, 0, key, [&key] {
+                    return "variable \"" + key + "\" is way too big"
+                        " and can't fit info long int";
+                });
             }
             error = Error::wrong_type;
             return 0;
@@ -463,7 +959,9 @@ public:
 
         if (!SnapTools::is_float(result)) {
             if (verbose)
-                debug("requested key '" + key + "' is not a floating type");
+                debug(Error::wrong_type, 0, key, [&key] {
+                    return "requested key '" + key + "' is not a floating type";
+                });
             error = Error::wrong_type;
             return 0;
         }
@@ -473,8 +971,10 @@ public:
         }
         catch (std::out_of_range ofr) {
             if (verbose) {
-                debug("variable \"" + key + "\" is"
-                      " way too big and can't fit into double");
+                debug(Error::wrong_type, 0, key, [&key] {
+                    return "variable \"" + key + "\" is"
+                        " way too big and can't fit into double";
+                });
             }
             error = Error::wrong_type;
             return 0;
@@ -545,10 +1045,45 @@ public:
         return set_default(key, std::to_string(value));
     }
 
-    void debug(const std::string& message,
-               const std::string& message_type = "error",
-               const char end_char = '\n')
+    // Replaces the sink diagnostics are reported to. nullptr disables them
+    void set_diagnostic_sink(std::shared_ptr<SnapDiagnostics::Sink> sink)
+    {
+        diagnostic_sink = std::move(sink);
+    }
+
+    std::shared_ptr<SnapDiagnostics::Sink> get_diagnostic_sink()
+    {
+        return diagnostic_sink;
+    }
+
+    // Reports a diagnostic. make_message is only called when a sink is
+    // attached, so the message text costs nothing otherwise
+    template<typename MakeMessage>
+    void debug([[maybe_unused]] const short code,
+               [[maybe_unused]] const int line_number,
+               [[maybe_unused]] const std::string& key,
+               [[maybe_unused]] MakeMessage&& make_message,
+               [[maybe_unused]] const char* message_type = "error")
+    {
+#ifndef SNAPCONFIG_NO_DIAGNOSTICS
+        if (!diagnostic_sink)
+            return;
+
+        diagnostic_sink->write({code, line_number, key,
+            std::string(make_message()), message_type});
+#endif
+    }
+
+    void debug([[maybe_unused]] const std::string& message,
+               [[maybe_unused]] const std::string& message_type = "error",
+               [[maybe_unused]] const char end_char = '\n')
     {
-        std::cerr << "SnapConfig[" << message_type << "]: " << message << end_char;
+#ifndef SNAPCONFIG_NO_DIAGNOSTICS
+        if (!diagnostic_sink)
+            return;
+
+        diagnostic_sink->write({Error::no_error, 0, "", message, message_type,
+            end_char});
+#endif
     }
 };
@@ -0,0 +1,88 @@
+/* 
+ * This file is part of SnapConfig.
+ *
+ * Loads the same config file into 1000 SnapConfig instances, once with
+ * separate strings and once with a shared StringPool, and prints resident
+ * memory before and after loading. Each run happens in its own process so
+ * memory freed by the first one doesn't skew the second. Linux only.
+ *
+ * SnapConfig is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version. This
+ * program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include"../SnapConfig.h"
+#include<iostream>
+#include<sys/wait.h>
+#include<unistd.h>
+
+const int instance_count{1000};
+
+// Resident memory of this process in KiB
+long resident_kib()
+{
+    std::ifstream statm{"/proc/self/statm"};
+    long pages{};
+    long resident{};
+    statm >> pages >> resident;
+
+    return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+void run(const bool use_pool)
+{
+    std::shared_ptr<SnapTools::StringPool> pool;
+
+    if (use_pool)
+        pool = SnapTools::StringPool::create();
+
+    std::vector<std::unique_ptr<SnapConfig>> configs;
+    configs.reserve(instance_count);
+    const long before{resident_kib()};
+
+    for (int i{}; i < instance_count; ++i) {
+        configs.push_back(std::make_unique<SnapConfig>("benchmark.conf", ':',
+            '\\', SnapDiagnostics::get_default_sink(), pool));
+    }
+
+    const long after{resident_kib()};
+
+    std::cout << (use_pool ? "string pool:      " : "separate strings: ")
+        << "before " << before << " KiB, after " << after << " KiB, "
+        << "loaded " << after - before << " KiB";
+
+    if (pool)
+        std::cout << " (" << pool->size() << " pooled strings)";
+
+    std::cout << "\n";
+}
+
+int main()
+{
+    SnapConfig probe{"benchmark.conf"};
+
+    if (!probe.is_config_init())
+        return 1;
+
+    std::cout << instance_count << " instances, "
+        << probe.config_variables.size() << " variables each\n";
+
+    for (const bool use_pool : {false, true}) {
+        std::cout.flush();
+        const pid_t pid{fork()};
+
+        if (!pid) {
+            run(use_pool);
+            return 0;
+        }
+
+        waitpid(pid, nullptr, 0);
+    }
+
+    return 0;
+}
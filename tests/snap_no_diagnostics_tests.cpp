@@ -0,0 +1,51 @@
+/* 
+ * This file is part of SnapConfig.
+ *
+ * Checks that SnapConfig built with SNAPCONFIG_NO_DIAGNOSTICS stays silent.
+ * It's a separate executable, since the header can't be included with and
+ * without the switch in one program.
+ *
+ * SnapConfig is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version. This
+ * program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define SNAPCONFIG_NO_DIAGNOSTICS
+
+#include<catch2/catch_amalgamated.hpp>
+#include<sstream>
+#include"../SnapConfig.h"
+
+struct CountingSink : SnapDiagnostics::Sink {
+    int count{};
+
+    void write(const SnapDiagnostics::Message&) override
+    {
+        ++count;
+    }
+};
+
+TEST_CASE("Diagnostics are compiled out", "[no_diagnostics]") {
+    REQUIRE(!SnapDiagnostics::get_default_sink());
+
+    std::ostringstream captured;
+    std::streambuf* const cerr_buffer{std::cerr.rdbuf(captured.rdbuf())};
+
+    SnapConfig config{"malformed.conf"};
+    REQUIRE(config.get("valid") == "value");
+    config.get("nonexistent_var", true);
+    config.debug("message");
+
+    std::cerr.rdbuf(cerr_buffer);
+    REQUIRE(captured.str().empty());
+
+    auto sink{std::make_shared<CountingSink>()};
+    SnapConfig sink_config{"malformed.conf", ':', '\\', sink};
+    sink_config.get("nonexistent_var", true);
+    REQUIRE(sink->count == 0);
+}
@@ -89,3 +89,145 @@ TEST_CASE("SnapConfig are tested", "[snapconfig]") {
 
     REQUIRE(config.config_variables.size() == 10);
 }
+
+struct CollectingSink : SnapDiagnostics::Sink {
+    std::vector<SnapDiagnostics::Message> messages;
+
+    void write(const SnapDiagnostics::Message& message) override
+    {
+        messages.push_back(message);
+    }
+};
+
+// Holds the AsyncSink worker inside write() until released
+struct BlockingSink : CollectingSink {
+    std::atomic<bool> entered{};
+    std::atomic<bool> released{};
+
+    void write(const SnapDiagnostics::Message& message) override
+    {
+        entered = true;
+
+        while (!released)
+            std::this_thread::yield();
+
+        CollectingSink::write(message);
+    }
+};
+
+TEST_CASE("Diagnostics are tested", "[diagnostics]") {
+    auto sink{std::make_shared<CollectingSink>()};
+    SnapConfig config{"malformed.conf", ':', '\\', sink};
+    REQUIRE(config.get("valid") == "value");
+
+    REQUIRE(sink->messages.size() == 2);
+    REQUIRE(sink->messages[0].code == SnapConfig::Error::syntax);
+    REQUIRE(sink->messages[0].line_number == 2);
+    REQUIRE(sink->messages[1].line_number == 3);
+    REQUIRE(sink->messages[1].key == "no separator here");
+
+    config.get("nonexistent_var", true);
+    REQUIRE(sink->messages.size() == 3);
+    REQUIRE(sink->messages[2].code == SnapConfig::Error::variable_not_found);
+    REQUIRE(sink->messages[2].key == "nonexistent_var");
+
+    config.set_diagnostic_sink(nullptr);
+    config.get("nonexistent_var", true);
+    REQUIRE(sink->messages.size() == 3);
+
+    auto collected{std::make_shared<CollectingSink>()};
+    {
+        auto async_sink{std::make_shared<SnapDiagnostics::AsyncSink>(collected, 4)};
+        config.set_diagnostic_sink(async_sink);
+
+        for (int i{}; i < 3; ++i)
+            config.get("nonexistent_var", true);
+
+        async_sink->flush();
+        REQUIRE(collected->messages.size() == 3);
+
+        config.set_diagnostic_sink(nullptr);
+        SnapConfig async_config{"malformed.conf", ':', '\\', async_sink};
+    }
+    REQUIRE(collected->messages.size() == 5);
+    REQUIRE(collected->messages[4].line_number == 3);
+
+    config.set_diagnostic_sink(sink);
+    config.debug("partial line", "info", ' ');
+    REQUIRE(sink->messages.back().text == "partial line");
+    REQUIRE(sink->messages.back().end_char == ' ');
+
+    auto blocking{std::make_shared<BlockingSink>()};
+    SnapDiagnostics::AsyncSink full_sink{blocking, 4};
+    full_sink.write({});
+
+    while (!blocking->entered)
+        std::this_thread::yield();
+
+    const size_t written{20};
+    for (size_t i{1}; i < written; ++i)
+        full_sink.write({});
+
+    REQUIRE(full_sink.get_dropped() > 0);
+    blocking->released = true;
+    full_sink.flush();
+    REQUIRE(blocking->messages.size() + full_sink.get_dropped() == written);
+}
+
+TEST_CASE("String pool is tested", "[pool]") {
+    auto pool{SnapTools::StringPool::create()};
+    const SnapTools::SharedString first{pool->intern("value")};
+    REQUIRE(first == pool->intern("value"));
+    REQUIRE(first == "value");
+    REQUIRE(pool->size() == 1);
+
+    {
+        SnapConfig config1{"test.conf", ':', '\\', nullptr, pool};
+        SnapConfig config2{"test.conf", ':', '\\', nullptr, pool};
+        REQUIRE(config1.get("multiline") == "This variable is multiline\n"
+            "and each line is stripped.");
+        REQUIRE(config2.get_int("num") == 8021);
+
+        REQUIRE(config1.config_variables.empty());
+        REQUIRE(config1.shared_variables.size() == 10);
+
+        for (size_t i{}; i < config1.shared_variables.size(); ++i) {
+            REQUIRE(config1.shared_variables[i].key
+                == config2.shared_variables[i].key);
+            REQUIRE(config1.shared_variables[i].value.c_str()
+                == config2.shared_variables[i].value.c_str());
+        }
+
+        REQUIRE(config1.shared_variables[0].key != config1.shared_variables[1].key);
+
+        REQUIRE(config1.get(pool->intern("string")) == "Test string");
+        REQUIRE(!config1.get_error());
+        REQUIRE(config1.get(SnapTools::StringPool::create()->intern("num")) == "8021");
+        config1.get(pool->intern("nonexistent_var"));
+        REQUIRE(config1.get_error() == SnapConfig::Error::variable_not_found);
+    }
+
+    REQUIRE(pool->size() == 1);
+
+    // Catch2 assertions aren't thread-safe, so threads only count failures
+    std::atomic<int> failures{};
+    std::vector<std::thread> threads;
+
+    for (int i{}; i < 4; ++i) {
+        threads.emplace_back([&pool, &failures] {
+            for (int j{}; j < 200; ++j) {
+                SnapConfig config{"test.conf", ':', '\\', nullptr, pool};
+
+                if (config.get_int("num") != 8021)
+                    ++failures;
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    REQUIRE(!failures);
+    REQUIRE(pool->size() == 1);
+    static_assert(!std::is_default_constructible_v<SnapTools::StringPool>);
+}